@@ -0,0 +1,259 @@
+#include "augment.h"
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+using namespace cv;
+using namespace std;
+
+typedef vector<Mat> MAT_VEC;
+
+//zero border around the source image copy, wide enough for bilinear neighbours of any coordinate
+//clamped to one pixel outside of the image
+#define PADDING 2
+
+namespace {
+    //blur the field in place along rows and then along columns, the edges are clamped
+    void blur(double* field, double* tmp, int rows, int cols, const vector<double>& kernel) {
+        int radius = kernel.size() / 2;
+        for (int row = 0; row < rows; ++row) {
+            const double* line = field + row * cols;
+            for (int col = 0; col < cols; ++col) {
+                double sum = 0;
+                for (int k = 0; k < kernel.size(); ++k) {
+                    int position = min(max(col + k - radius, 0), cols - 1);
+                    sum += kernel[k] * line[position];
+                }
+                tmp[row * cols + col] = sum;
+            }
+        }
+        for (int row = 0; row < rows; ++row) {
+            double* line = field + row * cols;
+            for (int col = 0; col < cols; ++col) {
+                line[col] = 0;
+            }
+            for (int k = 0; k < kernel.size(); ++k) {
+                const double* source = tmp + min(max(row + k - radius, 0), rows - 1) * cols;
+                double weight = kernel[k];
+                for (int col = 0; col < cols; ++col) {
+                    line[col] += weight * source[col];
+                }
+            }
+        }
+    }
+}
+
+Augmenter::Augmenter(MAT_VEC& images,
+                     MAT_VEC& labels,
+                     int imageRows,
+                     int imageCols,
+                     int batchSize,
+                     unsigned seed,
+                     int threadCount,
+                     int queueSize,
+                     AugmentParams params) :
+    images(images),
+    labels(labels),
+    imageRows(imageRows),
+    imageCols(imageCols),
+    batchSize(batchSize),
+    seed(seed),
+    params(params),
+    nextProduced(0),
+    nextConsumed(0),
+    stallCount(0),
+    stopped(false) {
+    assert(!images.empty());
+    assert(images.size() == labels.size());
+    assert(images[0].rows * images[0].cols == imageRows * imageCols);
+    assert(batchSize > 0);
+    if (threadCount <= 0) {
+        threadCount = max(1, int(thread::hardware_concurrency()) - 1);
+    }
+    if (queueSize <= 0) {
+        queueSize = threadCount * 2;
+    }
+    //precompute smoothed and scaled displacement fields for elastic distortion, blurring is much
+    //more expensive than the rest of the sample transformation
+    if (params.elasticAlpha > 0 && params.elasticSigma > 0 && params.elasticFieldCount > 0) {
+        int radius = int(ceil(params.elasticSigma * 3));
+        vector<double> gaussianKernel;
+        double sum = 0;
+        for (int i = -radius; i <= radius; ++i) {
+            double weight = exp(-(i * i) / (2 * params.elasticSigma * params.elasticSigma));
+            gaussianKernel.push_back(weight);
+            sum += weight;
+        }
+        for (int i = 0; i < gaussianKernel.size(); ++i) {
+            gaussianKernel[i] /= sum;
+        }
+        int size = imageRows * imageCols;
+        mt19937 rng(seed);
+        uniform_real_distribution<double> unit(-1, 1);
+        vector<double> tmp(size);
+        elasticFields.resize(params.elasticFieldCount * size);
+        for (int i = 0; i < params.elasticFieldCount; ++i) {
+            double* field = elasticFields.data() + i * size;
+            for (int j = 0; j < size; ++j) {
+                field[j] = unit(rng);
+            }
+            blur(field, tmp.data(), imageRows, imageCols, gaussianKernel);
+            for (int j = 0; j < size; ++j) {
+                field[j] *= params.elasticAlpha;
+            }
+        }
+    }
+    if (elasticFields.empty()) {
+        //single zero field, so elastic distortion needs no special case later
+        elasticFields.assign(imageRows * imageCols, 0.0);
+    }
+    //allocate all buffers upfront, workers only overwrite them later
+    buffers.resize(queueSize);
+    for (int i = 0; i < buffers.size(); ++i) {
+        Batch& batch = buffers[i];
+        batch.sequence = -1;
+        batch.images.reserve(batchSize);
+        for (int j = 0; j < batchSize; ++j) {
+            batch.images.push_back(Mat(imageRows * imageCols, 1, CV_64F));
+        }
+        batch.labels.resize(batchSize);
+        freeBuffers.push_back(&batch);
+    }
+    workers.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        workers.push_back(thread(&Augmenter::work, this));
+    }
+}
+
+Augmenter::~Augmenter() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopped = true;
+    }
+    freeCondition.notify_all();
+    readyCondition.notify_all();
+    for (int i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+}
+
+Augmenter::Batch* Augmenter::next() {
+    unique_lock<mutex> guard(lock);
+    auto it = readyBuffers.find(nextConsumed);
+    if (it == readyBuffers.end()) {
+        stallCount++;
+        readyCondition.wait(guard, [&]() {
+            it = readyBuffers.find(nextConsumed);
+            return it != readyBuffers.end();
+        });
+    }
+    Batch* batch = it->second;
+    readyBuffers.erase(it);
+    nextConsumed++;
+    return batch;
+}
+
+void Augmenter::recycle(Batch* batch) {
+    {
+        lock_guard<mutex> guard(lock);
+        freeBuffers.push_back(batch);
+    }
+    freeCondition.notify_one();
+}
+
+long long Augmenter::getStallCount() {
+    lock_guard<mutex> guard(lock);
+    return stallCount;
+}
+
+void Augmenter::work() {
+    //source image copy with zero border, reused for every sample of this worker
+    vector<double> padded((imageRows + 2 * PADDING) * (imageCols + 2 * PADDING), 0.0);
+    while (true) {
+        Batch* batch;
+        {
+            unique_lock<mutex> guard(lock);
+            freeCondition.wait(guard, [&]() { return stopped || !freeBuffers.empty(); });
+            if (stopped) {
+                return;
+            }
+            //sequence is taken together with a buffer, so the oldest pending batch always has
+            //a worker and the consumer can't be starved by batches from the future
+            batch = freeBuffers.back();
+            freeBuffers.pop_back();
+            batch->sequence = nextProduced++;
+        }
+        fill(*batch, padded);
+        {
+            lock_guard<mutex> guard(lock);
+            readyBuffers[batch->sequence] = batch;
+        }
+        readyCondition.notify_all();
+    }
+}
+
+void Augmenter::fill(Batch& batch, vector<double>& padded) {
+    //seed from the batch sequence number, so the result doesn't depend on which worker made it
+    seed_seq sequenceSeed { seed, unsigned(batch.sequence), unsigned(batch.sequence >> 32) };
+    mt19937 rng(sequenceSeed);
+    uniform_int_distribution<int> pickIndex(0, images.size() - 1);
+    int size = imageRows * imageCols;
+    uniform_int_distribution<int> pickField(0, elasticFields.size() / size - 1);
+    uniform_real_distribution<double> unit(-1, 1);
+
+    int paddedCols = imageCols + 2 * PADDING;
+    double centerX = (imageCols - 1) / 2.0;
+    double centerY = (imageRows - 1) / 2.0;
+    for (int i = 0; i < batchSize; ++i) {
+        int index = pickIndex(rng);
+        batch.labels[i] = labels[index];
+        const double* source = (const double*) images[index].data;
+        double* destination = (double*) batch.images[i].data;
+
+        double angle = params.maxRotation * unit(rng);
+        double shiftX = params.maxShift * unit(rng);
+        double shiftY = params.maxShift * unit(rng);
+        double cosAngle = cos(angle);
+        double sinAngle = sin(angle);
+        //independent displacement fields for both axes, sign flip keeps their distribution
+        const double* dx = elasticFields.data() + pickField(rng) * size;
+        const double* dy = elasticFields.data() + pickField(rng) * size;
+        double signX = unit(rng) < 0 ? -1 : 1;
+        double signY = unit(rng) < 0 ? -1 : 1;
+        //border stays zero, only the image itself is overwritten
+        for (int row = 0; row < imageRows; ++row) {
+            copy(source + row * imageCols, source + (row + 1) * imageCols,
+                 padded.begin() + (row + PADDING) * paddedCols + PADDING);
+        }
+        //map every destination pixel back to the source image and interpolate it, coordinates are
+        //shifted into the padded image and clamped to one pixel outside of the source, so all four
+        //neighbours are always inside of the buffer and the loop needs no branches
+        double minX = PADDING - 1;
+        double maxX = imageCols + PADDING;
+        double minY = PADDING - 1;
+        double maxY = imageRows + PADDING;
+        for (int row = 0; row < imageRows; ++row) {
+            double v = row - centerY;
+            for (int col = 0; col < imageCols; ++col) {
+                double u = col - centerX;
+                int position = row * imageCols + col;
+                double sourceX = cosAngle * u + sinAngle * v + centerX - shiftX
+                        + signX * dx[position] + PADDING;
+                double sourceY = -sinAngle * u + cosAngle * v + centerY - shiftY
+                        + signY * dy[position] + PADDING;
+                sourceX = min(max(sourceX, minX), maxX);
+                sourceY = min(max(sourceY, minY), maxY);
+                //coordinates are positive, so truncation is floor
+                int x = int(sourceX);
+                int y = int(sourceY);
+                double fx = sourceX - x;
+                double fy = sourceY - y;
+                const double* topLine = padded.data() + y * paddedCols + x;
+                const double* bottomLine = topLine + paddedCols;
+                double top = (1 - fx) * topLine[0] + fx * topLine[1];
+                double bottom = (1 - fx) * bottomLine[0] + fx * bottomLine[1];
+                destination[position] = (1 - fy) * top + fy * bottom;
+            }
+        }
+    }
+}
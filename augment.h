@@ -0,0 +1,77 @@
+#ifndef AUGMENT_H
+#define AUGMENT_H
+#include <opencv2/core/core.hpp>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AugmentParams {
+    //maximum shift in pixels along each axis
+    double maxShift = 2;
+    //maximum rotation angle in radians in both directions
+    double maxRotation = 0.15;
+    //elastic distortion strength and smoothness in pixels as in Simard et al., with uniform [-1, 1]
+    //fields smoothed by gaussian with sigma 4 it gives about 1.4 pixels RMS displacement,
+    //zero alpha disables it
+    double elasticAlpha = 34;
+    double elasticSigma = 4;
+    //count of smoothed displacement fields computed upfront, each sample picks two of them
+    //with random signs instead of smoothing new ones
+    int elasticFieldCount = 256;
+};
+
+class Augmenter {
+public:
+    struct Batch {
+        long long sequence;
+        std::vector<cv::Mat> images;
+        std::vector<cv::Mat> labels;
+    };
+
+    //start threadCount workers (0 - one per core except the training one) producing batches of
+    //batchSize randomly picked and distorted samples into at most queueSize reusable buffers
+    //(0 - twice the workers count), the produced sequence depends only on the seed
+    Augmenter(std::vector<cv::Mat>& images,
+              std::vector<cv::Mat>& labels,
+              int imageRows,
+              int imageCols,
+              int batchSize,
+              unsigned seed,
+              int threadCount = 0,
+              int queueSize = 0,
+              AugmentParams params = AugmentParams()
+              );
+    ~Augmenter();
+    //block until the next batch in sequence order is ready, the batch must be given back by recycle
+    Batch* next();
+    void recycle(Batch* batch);
+    //count of next() calls which had to wait for workers
+    long long getStallCount();
+
+private:
+    std::vector<cv::Mat>& images;
+    std::vector<cv::Mat>& labels;
+    const int imageRows;
+    const int imageCols;
+    const int batchSize;
+    const unsigned seed;
+    const AugmentParams params;
+    std::vector<double> elasticFields;
+    std::vector<Batch> buffers;
+    std::vector<Batch*> freeBuffers;
+    std::map<long long, Batch*> readyBuffers;
+    long long nextProduced;
+    long long nextConsumed;
+    long long stallCount;
+    bool stopped;
+    std::mutex lock;
+    std::condition_variable freeCondition;
+    std::condition_variable readyCondition;
+    std::vector<std::thread> workers;
+    void work();
+    void fill(Batch& batch, std::vector<double>& padded);
+};
+
+#endif // AUGMENT_H
@@ -1,5 +1,5 @@
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++11 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 INCLUDEPATH += /usr/local/include/
@@ -7,8 +7,20 @@ LIBS += -L/usr/local/lib/ -lopencv_highgui -lopencv_core
 
 SOURCES += main.cpp \
     nn.cpp \
-    utils.cpp
+    utils.cpp \
+    sweep.cpp \
+    augment.cpp \
+    online.cpp \
+    stream.cpp \
+    distill.cpp \
+    tuner.cpp
 
 HEADERS += \
     nn.h \
-    utils.h
+    utils.h \
+    sweep.h \
+    augment.h \
+    online.h \
+    stream.h \
+    distill.h \
+    tuner.h
@@ -0,0 +1,90 @@
+#include "distill.h"
+#include "utils.h"
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+using namespace cv;
+using namespace std;
+
+typedef vector<Mat> MAT_VEC;
+
+namespace distill {
+    void computeSoftTargets(const NN& teacher,
+                            MAT_VEC& images,
+                            double temperature,
+                            MAT_VEC& softTargets,
+                            int threadCount) {
+        assert(temperature > 0);
+        int outputSize = teacher.getConfig().back();
+        softTargets.clear();
+        softTargets.reserve(images.size());
+        for (int i = 0; i < images.size(); ++i) {
+            softTargets.push_back(Mat(outputSize, 1, CV_64F));
+        }
+        if (threadCount <= 0) {
+            threadCount = max(1u, thread::hardware_concurrency());
+        }
+        //teacher is only read, so every thread just needs its own context and range of images
+        auto worker = [&](int from, int to) {
+            InferenceContext context(teacher);
+            for (int i = from; i < to; ++i) {
+                teacher.predict((const double*) images[i].data, context);
+                const double* logits = context.getLogits();
+                double* target = (double*) softTargets[i].data;
+                for (int j = 0; j < outputSize; ++j) {
+                    target[j] = utils::sigmoid(logits[j] / temperature);
+                }
+            }
+        };
+        vector<thread> workers;
+        int step = (images.size() + threadCount - 1) / threadCount;
+        for (int from = 0; from < images.size(); from += step) {
+            workers.push_back(thread(worker, from, min<int>(from + step, images.size())));
+        }
+        for (int i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+
+    void blendTargets(MAT_VEC& softTargets,
+                      MAT_VEC& hardTargets,
+                      double softWeight,
+                      MAT_VEC& blendedTargets) {
+        assert(softTargets.size() == hardTargets.size());
+        blendedTargets.clear();
+        blendedTargets.reserve(softTargets.size());
+        for (int i = 0; i < softTargets.size(); ++i) {
+            blendedTargets.push_back(softTargets[i] * softWeight + hardTargets[i] * (1 - softWeight));
+        }
+    }
+
+    Report measure(const NN& net, MAT_VEC& images, MAT_VEC& labels, NN::InferenceKernel kernel) {
+        assert(images.size() == labels.size());
+        InferenceContext context(net);
+        Report report;
+        report.correct = 0;
+        report.total = images.size();
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < images.size(); ++i) {
+            int computed;
+            if (kernel == NN::KERNEL_LOOP) {
+                computed = net.predict((const double*) images[i].data, context);
+            } else {
+                Mat output = net.feedfoward(images[i]);
+                computed = 0;
+                for (int j = 1; j < output.rows; ++j) {
+                    if (output.at<double>(j, 0) > output.at<double>(computed, 0)) {
+                        computed = j;
+                    }
+                }
+            }
+            if (computed >= 0 && labels[i].at<double>(computed, 0) == 1) {
+                report.correct++;
+            }
+        }
+        double elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        report.microsecondsPerSample = images.empty() ? 0 : elapsed / images.size();
+        return report;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef DISTILL_H
+#define DISTILL_H
+#include "nn.h"
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace distill {
+    struct Report {
+        int correct;
+        int total;
+        double microsecondsPerSample;
+    };
+
+    //compute teacher outputs softened with temperature (sigmoid of the last layer results divided
+    //by temperature) for every image using threadCount threads (0 - one per core)
+    void computeSoftTargets(const NN& teacher,
+                            std::vector<cv::Mat>& images,
+                            double temperature,
+                            std::vector<cv::Mat>& softTargets,
+                            int threadCount = 0
+                            );
+
+    //mix soft and hard targets as softWeight * soft + (1 - softWeight) * hard, with quadratic cost
+    //it gives the same gradients as mixing both costs with those weights
+    void blendTargets(std::vector<cv::Mat>& softTargets,
+                      std::vector<cv::Mat>& hardTargets,
+                      double softWeight,
+                      std::vector<cv::Mat>& blendedTargets
+                      );
+
+    //single thread accuracy and average latency of the given inference kernel
+    Report measure(const NN& net,
+                   std::vector<cv::Mat>& images,
+                   std::vector<cv::Mat>& labels,
+                   NN::InferenceKernel kernel
+                   );
+}
+
+#endif // DISTILL_H
@@ -7,6 +7,14 @@
 #include <math.h>
 #include "utils.h"
 #include "nn.h"
+#include "sweep.h"
+#include "augment.h"
+#include "online.h"
+#include "stream.h"
+#include "distill.h"
+#include "tuner.h"
+#include <chrono>
+#include <thread>
 
 using namespace std;
 using namespace cv;
@@ -17,7 +25,7 @@ typedef vector<Mat> MAT_VEC;
 #define SHOW_ALL_IMAGES 0
 #define SHOW_VALIDATE_IMAGES 0
 
-int readImages(const char* fileName, MAT_VEC& images) {
+int readImages(const char* fileName, MAT_VEC& images, int* rows = 0, int* cols = 0) {
     ifstream trainingData(fileName, ios::in|ios::binary);
     if (!trainingData.is_open()) {
         cout << "Failed to open file";
@@ -44,6 +52,12 @@ int readImages(const char* fileName, MAT_VEC& images) {
     if (numberOfRow <= 0 || numberOfColumns <= 0) {
         return -1;
     }
+    if (rows) {
+        *rows = numberOfRow;
+    }
+    if (cols) {
+        *cols = numberOfColumns;
+    }
     cout << "Number of images: " << numberOfImages << endl << "Size: " << numberOfRow << " X " << numberOfColumns << endl;
     images.reserve(numberOfImages);
     int imageSize = numberOfRow * numberOfColumns;
@@ -125,11 +139,19 @@ int readLabels(const char* fileName, MAT_VEC& lables) {
 void readMnistData(MAT_VEC& trainingImages,
                    MAT_VEC& trainingLabels,
                    MAT_VEC& validateImages,
-                   MAT_VEC& validateLabels) {
-    readImages("../train-images.idx3-ubyte", trainingImages);
+                   MAT_VEC& validateLabels,
+                   int& imageRows,
+                   int& imageCols) {
+    imageRows = 0;
+    imageCols = 0;
+    int validateRows = 0;
+    int validateCols = 0;
+    readImages("../train-images.idx3-ubyte", trainingImages, &imageRows, &imageCols);
     readLabels("../train-labels.idx1-ubyte", trainingLabels);
-    readImages("../t10k-images.idx3-ubyte", validateImages);
+    readImages("../t10k-images.idx3-ubyte", validateImages, &validateRows, &validateCols);
     readLabels("../t10k-labels.idx1-ubyte", validateLabels);
+    assert(imageRows > 0 && imageCols > 0);
+    assert(imageRows == validateRows && imageCols == validateCols);
     assert(trainingImages.size() == trainingLabels.size());
     assert(trainingImages.size() > 1);
     assert(validateImages.size() == validateLabels.size());
@@ -153,6 +175,211 @@ void showMnistData(MAT_VEC& images, MAT_VEC& labels) {
     }
 }
 
+int runSweep(MAT_VEC& trainingImages,
+             MAT_VEC& trainingLabels,
+             MAT_VEC& validateImages,
+             MAT_VEC& validateLabels,
+             const char* resultsFileName,
+             const tuner::Profile& profile) {
+    ofstream results(resultsFileName, ios::out|ios::trunc);
+    if (!results.is_open()) {
+        cout << "Failed to open file";
+        return -1;
+    }
+    vector<vector<int>> hiddenLayers = { {30}, {60}, {100}, {30, 30} };
+    vector<int> epochItemCounts = { 30, 100 };
+    vector<int> epochCounts = { 3000 };
+    vector<double> learningRates = { 1, 3, 5 };
+    vector<sweep::Config> configs;
+    for (auto& hidden : hiddenLayers) {
+        for (int epochItemCount : epochItemCounts) {
+            for (int epochCount : epochCounts) {
+                for (double learningRate : learningRates) {
+                    configs.push_back({ hidden, epochItemCount, epochCount, learningRate });
+                }
+            }
+        }
+    }
+    cout << "sweep: " << configs.size() << " configurations" << endl;
+    unsigned seed = 1;
+    vector<sweep::Result> ranked = sweep::run(trainingImages, trainingLabels,
+                                              validateImages, validateLabels,
+                                              configs, results, seed, profile.inferenceKernel);
+    cout << "ranking:" << endl;
+    for (int i = 0; i < ranked.size(); ++i) {
+        cout << i + 1 << ". " << ranked[i].correct << "/" << ranked[i].total << " "
+             << ranked[i].seconds << "s ";
+        sweep::traceConfig(cout, ranked[i].config);
+        cout << endl;
+    }
+    return ranked.size();
+}
+
+void trainAugmented(NN& net,
+                    MAT_VEC& trainingImages,
+                    MAT_VEC& trainingLabels,
+                    int imageRows,
+                    int imageCols,
+                    int epochItemCount,
+                    int epochCount,
+                    double learningRate,
+                    unsigned seed) {
+    Augmenter augmenter(trainingImages, trainingLabels, imageRows, imageCols, epochItemCount, seed);
+    for (int i = 0; i < epochCount; ++i) {
+        Augmenter::Batch* batch = augmenter.next();
+        net.trainBatch(batch->images, batch->labels, learningRate);
+        augmenter.recycle(batch);
+    }
+    cout << "augmentation stalls: " << augmenter.getStallCount() << "/" << epochCount << endl;
+}
+
+//train on augmented batches of 1000 with default augmentation settings and fail if the training
+//loop had to wait for augmentation in more than 5% of the batches or 5% of the time
+int checkAugmentation(MAT_VEC& trainingImages,
+                      MAT_VEC& trainingLabels,
+                      int imageRows,
+                      int imageCols,
+                      int epochCount) {
+    vector<int> config = { trainingImages[0].rows, 30, trainingLabels[0].rows };
+    NN net(config, 1);
+    Augmenter augmenter(trainingImages, trainingLabels, imageRows, imageCols, 1000, 1);
+    //the first batch always waits for workers to start, don't count it
+    augmenter.recycle(augmenter.next());
+    long long warmupStalls = augmenter.getStallCount();
+    double waitSeconds = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < epochCount; ++i) {
+        auto waitStart = chrono::steady_clock::now();
+        Augmenter::Batch* batch = augmenter.next();
+        waitSeconds += chrono::duration<double>(chrono::steady_clock::now() - waitStart).count();
+        net.trainBatch(batch->images, batch->labels, 5);
+        augmenter.recycle(batch);
+    }
+    double totalSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double stallRate = double(augmenter.getStallCount() - warmupStalls) / epochCount;
+    double waitRate = waitSeconds / totalSeconds;
+    cout << "augmentation stall rate: " << stallRate
+         << " wait time: " << waitSeconds << "s/" << totalSeconds << "s"
+         << " training: " << epochCount * 1000 / totalSeconds << " samples/s" << endl;
+    return stallRate <= 0.05 && waitRate <= 0.05 ? 0 : 1;
+}
+
+int evaluateSnapshot(const NN& net, MAT_VEC& images, MAT_VEC& labels) {
+    InferenceContext context(net);
+    vector<float> input(images[0].rows * images[0].cols);
+    int count = 0;
+    for (int i = 0; i < images.size(); ++i) {
+        const double* imagePoint = (const double*) images[i].data;
+        for (int j = 0; j < input.size(); ++j) {
+            input[j] = imagePoint[j];
+        }
+        int computed = net.predict(input.data(), context);
+        if (computed >= 0 && labels[i].at<double>(computed, 0) == 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void trainOnline(NN& net,
+                 MAT_VEC& trainingImages,
+                 MAT_VEC& trainingLabels,
+                 MAT_VEC& validateImages,
+                 MAT_VEC& validateLabels,
+                 int seconds) {
+    OnlineTrainer trainer(net, 10000, 100, 3, 10, 1);
+    //feed training samples as a stream while a snapshot of the network keeps being validated
+    int pushed = 0;
+    for (int i = 0; i < seconds; ++i) {
+        auto until = chrono::steady_clock::now() + chrono::seconds(1);
+        while (pushed < trainingImages.size() && chrono::steady_clock::now() < until) {
+            trainer.push(trainingImages[pushed], trainingLabels[pushed]);
+            pushed++;
+            this_thread::sleep_for(chrono::microseconds(100));
+        }
+        this_thread::sleep_until(until);
+        shared_ptr<const NN> snapshot = trainer.getSnapshot();
+        cout << "seen: " << trainer.getSeenCount()
+             << " updates: " << trainer.getUpdatesCount()
+             << " validate: " << evaluateSnapshot(*snapshot, validateImages, validateLabels)
+             << "/" << validateLabels.size() << endl;
+    }
+}
+
+int trainStreaming(const char* imagesFileName,
+                   const char* labelsFileName,
+                   int epochItemCount,
+                   int passes,
+                   double learningRate,
+                   const tuner::Profile& profile) {
+    MnistStream stream(imagesFileName, labelsFileName, 10, 4096, 16384, 4, passes, 1);
+    if (!stream.isOpen()) {
+        return -1;
+    }
+    MAT_VEC images;
+    MAT_VEC labels;
+    for (int i = 0; i < epochItemCount; ++i) {
+        images.push_back(Mat(stream.getSampleSize(), 1, CV_64F));
+        labels.push_back(Mat(stream.getLabelsCount(), 1, CV_64F));
+    }
+    vector<int> config = { images[0].rows, 30, labels[0].rows };
+    NN net(config);
+    long long trained = 0;
+    int count;
+    while ((count = stream.next(images, labels)) > 0) {
+        if (count < images.size()) {
+            images.resize(count);
+            labels.resize(count);
+        }
+        net.trainBatch(images, labels, learningRate);
+        trained += count;
+    }
+    cout << "streamed samples: " << trained << endl;
+
+    MAT_VEC validateImages;
+    MAT_VEC validateLabels;
+    readImages("../t10k-images.idx3-ubyte", validateImages);
+    readLabels("../t10k-labels.idx1-ubyte", validateLabels);
+    cout << "validate:" << endl;
+    cout << net.evaluate(validateImages, validateLabels, profile.inferenceKernel)
+         << "/" << validateLabels.size() << endl;
+    return 0;
+}
+
+void traceReport(const char* name, const distill::Report& report) {
+    cout << name << ": " << report.correct << "/" << report.total << " "
+         << report.microsecondsPerSample << "us per sample" << endl;
+}
+
+void trainDistilled(MAT_VEC& trainingImages,
+                    MAT_VEC& trainingLabels,
+                    MAT_VEC& validateImages,
+                    MAT_VEC& validateLabels,
+                    double temperature,
+                    double softWeight,
+                    const tuner::Profile& profile) {
+    int inputSize = trainingImages[0].rows;
+    int outputSize = trainingLabels[0].rows;
+    vector<int> teacherConfig = { inputSize, 100, outputSize };
+    NN teacher(teacherConfig);
+    teacher.train(trainingImages, trainingLabels, 1000, 20000, 5);
+
+    MAT_VEC softTargets;
+    distill::computeSoftTargets(teacher, trainingImages, temperature, softTargets,
+                                profile.inferenceThreads);
+    MAT_VEC blendedTargets;
+    distill::blendTargets(softTargets, trainingLabels, softWeight, blendedTargets);
+
+    vector<int> studentConfig = { inputSize, 16, outputSize };
+    NN student(studentConfig);
+    student.train(trainingImages, blendedTargets, 1000, 20000, 5);
+
+    traceReport("teacher", distill::measure(teacher, validateImages, validateLabels,
+                                            profile.inferenceKernel));
+    traceReport("student", distill::measure(student, validateImages, validateLabels,
+                                            profile.inferenceKernel));
+}
+
 int main(int argc, char *argv[]) {
 //    vector<int> config = {2, 3, 2, 1};
 //    NN net(config);
@@ -255,24 +482,74 @@ int main(int argc, char *argv[]) {
 //    cout << "evaluate:" << endl;
 //    cout << net.evaluate(input, output) << "/" << input.size() << endl;
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    const tuner::Profile& profile = tuner::getActiveProfile();
+    //streaming mode reads training data from disk on the fly, so don't load it upfront
+    if (argc > 1 && string(argv[1]) == "stream") {
+        return trainStreaming(argc > 2 ? argv[2] : "../train-images.idx3-ubyte",
+                              argc > 3 ? argv[3] : "../train-labels.idx1-ubyte",
+                              100, 30, 3, profile);
+    }
     MAT_VEC trainingImages;
     MAT_VEC trainingLabels;
     MAT_VEC validateImages;
     MAT_VEC validateLabels;
-    readMnistData(trainingImages, trainingLabels, validateImages, validateLabels);
+    int imageRows;
+    int imageCols;
+    readMnistData(trainingImages, trainingLabels, validateImages, validateLabels,
+                  imageRows, imageCols);
+    if (argc > 1 && string(argv[1]) == "sweep") {
+        runSweep(trainingImages, trainingLabels, validateImages, validateLabels,
+                 argc > 2 ? argv[2] : "sweep_results.txt", profile);
+        return 0;
+    }
 //    showMnistData(trainingImages, trainingLabels);
+    if (argc > 1 && string(argv[1]) == "augment-check") {
+        return checkAugmentation(trainingImages, trainingLabels, imageRows, imageCols,
+                                 argc > 2 ? stoi(argv[2]) : 200);
+    }
+    if (argc > 1 && string(argv[1]) == "tune") {
+        tuner::Profile tuned = tuner::tune(trainingImages, trainingLabels, 1);
+        cout << "best: items=" << tuned.epochItemCount
+             << " kernel=" << tuned.inferenceKernel
+             << " threads=" << tuned.inferenceThreads << endl;
+        return tuner::saveProfile(PROFILE_FILE_NAME, tuned) ? 0 : -1;
+    }
+    if (argc > 1 && string(argv[1]) == "distill") {
+        trainDistilled(trainingImages, trainingLabels, validateImages, validateLabels,
+                       argc > 2 ? stod(argv[2]) : 2,
+                       argc > 3 ? stod(argv[3]) : 0.5, profile);
+        return 0;
+    }
     int inputSize = trainingImages[0].rows;
     int outputSize = trainingLabels[0].rows;
     vector<int> config = { inputSize, 30, outputSize };
     NN net(config);
     cout << trainingImages.size() << " " << trainingLabels.size() << endl;
-    net.train(trainingImages, trainingLabels, 1000, 20000, 5);
+    if (argc > 1 && string(argv[1]) == "augment") {
+        trainAugmented(net, trainingImages, trainingLabels, imageRows, imageCols,
+                       1000, 20000, 5, argc > 2 ? stoul(argv[2]) : 1);
+    } else if (argc > 1 && string(argv[1]) == "online") {
+        trainOnline(net, trainingImages, trainingLabels, validateImages, validateLabels,
+                    argc > 2 ? stoi(argv[2]) : 60);
+        return 0;
+    } else if (argc > 1 && string(argv[1]) == "tuned") {
+        //keep the same total samples count as the default run, the mini-batch size still changes
+        //the count and size of the gradient steps, so results may differ from the default ones
+        int epochItemCount = profile.epochItemCount;
+        int epochCount = max(1, 1000 * 20000 / epochItemCount);
+        cout << "tuned mini-batch: " << epochItemCount << " epochs: " << epochCount << endl;
+        net.train(trainingImages, trainingLabels, epochItemCount, epochCount, 5);
+    } else {
+        net.train(trainingImages, trainingLabels, 1000, 20000, 5);
+    }
 
     cout << "evaluate:" << endl;
-    cout << net.evaluate(trainingImages, trainingLabels) << "/" << trainingLabels.size() << endl;
+    cout << net.evaluate(trainingImages, trainingLabels, profile.inferenceKernel)
+         << "/" << trainingLabels.size() << endl;
 
     cout << "validate:" << endl;
-    cout << net.evaluate(validateImages, validateLabels) << "/" << validateLabels.size() << endl;
+    cout << net.evaluate(validateImages, validateLabels, profile.inferenceKernel)
+         << "/" << validateLabels.size() << endl;
 
 #if SHOW_VALIDATE_IMAGES
     for (int i = 0; i < validateImages.size(); ++i) {
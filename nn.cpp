@@ -3,6 +3,7 @@
 #include <opencv2/core/core.hpp>
 #include <iostream>
 #include <algorithm>
+#include <memory>
 using namespace cv;
 using namespace std;
 
@@ -13,17 +14,22 @@ typedef vector<Mat> MAT_VEC;
 #define RAND_CONFIG 1
 
 NN::NN(vector<int>& config) :
-    layers(config) {
+    NN(config, unsigned(time(0))) {
+}
+
+NN::NN(vector<int>& config, unsigned seed) :
+    layers(config),
+    rng(seed),
+    trace(true) {
     weights.reserve(config.size() - 1);
     biases.reserve(config.size() - 1);
-    setRNGSeed(unsigned(time(0)));
+    RNG initRng(seed);
     for(int i = 1; i < config.size(); ++i) {
-        srand(unsigned(time(0)));
         Mat weight(config.at(i), config.at(i - 1), CV_64F);
         Mat bias(config.at(i), 1, CV_64F);
 #if RAND_CONFIG
-        randn(weight, 0, 1);
-        randn(bias, 0, 1);
+        initRng.fill(weight, RNG::NORMAL, 0, 1);
+        initRng.fill(bias, RNG::NORMAL, 0, 1);
 #else
         weight = Scalar(0.1);
         bias = Scalar(0.1);
@@ -33,6 +39,22 @@ NN::NN(vector<int>& config) :
     }
 }
 
+NN::NN(const NN& other) :
+    layers(other.layers),
+    rng(other.rng),
+    trace(other.trace) {
+    weights.reserve(other.weights.size());
+    biases.reserve(other.biases.size());
+    for (int i = 0; i < other.weights.size(); ++i) {
+        weights.push_back(other.weights[i].clone());
+        biases.push_back(other.biases[i].clone());
+    }
+}
+
+void NN::setTrace(bool enabled) {
+    trace = enabled;
+}
+
 void NN::traceConfig() {
     cout << "NN configuration:" << endl
          << "  Layers: " << layers.size() << endl
@@ -68,18 +90,41 @@ void NN::train(MAT_VEC& input,
     }
     for (int i = 0; i < epochCount; ++i) {
 #if TRACE
-        cout << "RUN TRAINING EPOCH " << i << " START" << endl;
+        if (trace) {
+            cout << "RUN TRAINING EPOCH " << i << " START" << endl;
+        }
 #endif
         vector<int> epochIndexes;
         epochIndexes.reserve(epochItemCount);
-        utils::shuffleOptimal<int>(indexes, epochIndexes);
+        utils::shuffleOptimal<int>(indexes, epochIndexes, rng);
 #if TRACE
-        cout << "RUN TRAINING EPOCH " << i << " END" <<  endl;
+        if (trace) {
+            cout << "RUN TRAINING EPOCH " << i << " END" <<  endl;
+        }
 #endif
         trainInternal(input, desiredOutput, epochIndexes, learningRate);
     }
 }
 
+void NN::trainBatch(MAT_VEC& input,
+                    MAT_VEC& desiredOutput,
+                    double learningRate) {
+    if (input.empty() ||
+            input.size() != desiredOutput.size() ||
+            !validate(input.at(0))) {
+#if EXTENDED_TRACE
+        cout << "ILLEGAL ARGUMENTS PROVIDED" << endl;
+#endif
+        return;
+    }
+    vector<int> indexes;
+    indexes.reserve(input.size());
+    for (int i = 0; i < input.size(); ++i) {
+        indexes.push_back(i);
+    }
+    trainInternal(input, desiredOutput, indexes, learningRate);
+}
+
 void NN::trainInternal(MAT_VEC &data,
                        MAT_VEC &desiredOutput,
                        vector<int> &indexes,
@@ -281,7 +326,7 @@ void NN::backpropagate(Mat &input,
     }
 }
 
-int NN::evaluate(MAT_VEC& input, MAT_VEC& desiredOutput) {
+int NN::evaluate(MAT_VEC& input, MAT_VEC& desiredOutput, InferenceKernel kernel) {
 //    Mat initial = feedfoward(input.at(0));
 //    cout << "INITIAL RESULT:" <<  endl << initial << endl;
 //    cout << "UPDATE:" << endl;
@@ -308,8 +353,18 @@ int NN::evaluate(MAT_VEC& input, MAT_VEC& desiredOutput) {
     //a desired value
     int count = 0;
     int rndCount = 0;
+    unique_ptr<InferenceContext> context;
+    if (kernel == KERNEL_LOOP) {
+        context.reset(new InferenceContext(*this));
+    }
     for (int i = 0; i < input.size(); ++i) {
-        Mat computedOutput = feedfoward(input[i]);
+        Mat computedOutput;
+        if (context) {
+            predict((const double*) input[i].data, *context);
+            computedOutput = Mat(layers.back(), 1, CV_64F, (void*) context->getScores());
+        } else {
+            computedOutput = feedfoward(input[i]);
+        }
         assert(computedOutput.cols == 1);
         assert(computedOutput.rows == layers.back());
         assert(computedOutput.cols == desiredOutput[i].cols);
@@ -341,16 +396,21 @@ int NN::evaluate(MAT_VEC& input, MAT_VEC& desiredOutput) {
         if (maxComputedIndex == maxDesiredIndex) {
             count++;
         }
-        if ((rand() % 9) == maxDesiredIndex) {
+#if TRACE
+        //random guess baseline, only needed for the trace output
+        if (trace && (rand() % 9) == maxDesiredIndex) {
             rndCount++;
         }
+#endif
 #if EXTENDED_TRACE
         cout << "DESIRED: " << desiredOutput[i] << endl << " COMPUTED: " << computedOutput << endl;
 #endif
     }
 #if TRACE
-    cout << "EQUAL INDEX COUNT: " << count << endl;
-    cout << "RND EQUAL INDEX COUNT: " << rndCount << endl;
+    if (trace) {
+        cout << "EQUAL INDEX COUNT: " << count << endl;
+        cout << "RND EQUAL INDEX COUNT: " << rndCount << endl;
+    }
 #endif
     return count;
 }
@@ -362,7 +422,7 @@ bool NN::validate(Mat &data) {
     return true;
 }
 
-Mat NN::feedfoward(Mat &input) {
+Mat NN::feedfoward(Mat &input) const {
    Mat feed = input.clone();
    for (int i = 0; i < weights.size(); ++i) {
        feed = weights.at(i) * feed + biases.at(i);
@@ -371,6 +431,122 @@ Mat NN::feedfoward(Mat &input) {
    return feed;
 }
 
+bool NN::fits(const InferenceContext& context) const {
+    if (context.activations.size() != layers.size() ||
+            context.logits.size() != layers.back()) {
+        return false;
+    }
+    for (int i = 0; i < layers.size(); ++i) {
+        if (context.activations[i].size() != layers[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <class T>
+int NN::predictInternal(const T* input, InferenceContext& context) const {
+    //layers count is tiny, so checking on every call costs nothing compared to the layers math
+    if (!fits(context)) {
+        return -1;
+    }
+    //convert input into the first layer buffer, all the rest is computed in place
+    double* feed = context.activations[0].data();
+    for (int i = 0; i < layers[0]; ++i) {
+        feed[i] = input[i];
+    }
+    for (int i = 0; i < weights.size(); ++i) {
+        const Mat& weight = weights[i];
+        const double* bias = biases[i].ptr<double>();
+        double* output = context.activations[i + 1].data();
+        bool last = i == weights.size() - 1;
+        for (int row = 0; row < weight.rows; ++row) {
+            const double* weightRow = weight.ptr<double>(row);
+            double sum = bias[row];
+            for (int col = 0; col < weight.cols; ++col) {
+                sum += weightRow[col] * feed[col];
+            }
+            if (last) {
+                context.logits[row] = sum;
+            }
+            output[row] = utils::sigmoid(sum);
+        }
+        feed = output;
+    }
+    int maxIndex = 0;
+    for (int i = 1; i < layers.back(); ++i) {
+        if (feed[i] > feed[maxIndex]) {
+            maxIndex = i;
+        }
+    }
+    return maxIndex;
+}
+
+int NN::predict(const uchar* input, InferenceContext& context) const {
+    return predictInternal(input, context);
+}
+
+int NN::predict(const float* input, InferenceContext& context) const {
+    return predictInternal(input, context);
+}
+
+int NN::predict(const double* input, InferenceContext& context) const {
+    return predictInternal(input, context);
+}
+
+void NN::predict(const uchar* input, int count, InferenceContext& context,
+                 int* results, double* scores) const {
+    if (!fits(context)) {
+        fill(results, results + count, -1);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        results[i] = predictInternal(input + i * layers.front(), context);
+        if (scores) {
+            copy(context.getScores(), context.getScores() + layers.back(), scores + i * layers.back());
+        }
+    }
+}
+
+void NN::predict(const float* input, int count, InferenceContext& context,
+                 int* results, double* scores) const {
+    if (!fits(context)) {
+        fill(results, results + count, -1);
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        results[i] = predictInternal(input + i * layers.front(), context);
+        if (scores) {
+            copy(context.getScores(), context.getScores() + layers.back(), scores + i * layers.back());
+        }
+    }
+}
+
+const vector<int>& NN::getConfig() const {
+    return layers;
+}
+
 int NN::getLayersCount() {
     return layers.size();
 }
+
+InferenceContext::InferenceContext(const NN& net) {
+    const vector<int>& layers = net.getConfig();
+    activations.resize(layers.size());
+    for (int i = 0; i < layers.size(); ++i) {
+        activations[i].resize(layers[i]);
+    }
+    logits.resize(layers.back());
+}
+
+const double* InferenceContext::getScores() const {
+    return activations.back().data();
+}
+
+int InferenceContext::getScoresCount() const {
+    return activations.back().size();
+}
+
+const double* InferenceContext::getLogits() const {
+    return logits.data();
+}
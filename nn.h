@@ -1,30 +1,72 @@
 #ifndef NN_H
 #define NN_H
 #include <opencv2/core/core.hpp>
+#include <random>
 #include <vector>
 
+class InferenceContext;
+
 class NN {
 public:
+    enum InferenceKernel {
+        //cv::Mat based feedfoward
+        KERNEL_MATRIX = 0,
+        //preallocated buffers based predict
+        KERNEL_LOOP = 1
+    };
+
     NN(std::vector<int>& config);
-    cv::Mat feedfoward(cv::Mat& input);
+    //weights initialization and training samples order depend only on the seed, so networks
+    //with different seeds can be trained in parallel reproducibly
+    NN(std::vector<int>& config, unsigned seed);
+    //deep copy, the new network doesn't share weights and biases with the original one
+    NN(const NN& other);
+    cv::Mat feedfoward(cv::Mat& input) const;
+    //reentrant inference: any number of threads may call it on one network at the same time
+    //as long as each one uses its own context and no training runs in parallel, returns the index
+    //of the biggest output, the outputs themselves are available from the context afterwards,
+    //-1 if the context was created for a network with different layer sizes
+    int predict(const uchar* input, InferenceContext& context) const;
+    int predict(const float* input, InferenceContext& context) const;
+    int predict(const double* input, InferenceContext& context) const;
+    //predict count samples stored one after another, scores may be null or hold
+    //count * outputs values, all results are -1 if the context doesn't fit the network
+    void predict(const uchar* input, int count, InferenceContext& context,
+                 int* results, double* scores = 0) const;
+    void predict(const float* input, int count, InferenceContext& context,
+                 int* results, double* scores = 0) const;
+    const std::vector<int>& getConfig() const;
     int getLayersCount();
     void traceConfig();
+    //enable or disable per epoch and evaluation trace output
+    void setTrace(bool enabled);
     void train(std::vector<cv::Mat>& input,
             std::vector<cv::Mat>& desiredOutput,
             int epochItemCount,
             int epochCount,
             double learningRate
     );
+    //single gradient descent step on the whole provided mini-batch
+    void trainBatch(std::vector<cv::Mat>& input,
+            std::vector<cv::Mat>& desiredOutput,
+            double learningRate
+    );
     int evaluate(
             std::vector<cv::Mat>& input,
-            std::vector<cv::Mat>& desiredOutput
+            std::vector<cv::Mat>& desiredOutput,
+            InferenceKernel kernel = KERNEL_MATRIX
     );
 
 private:
      const std::vector<int> layers;
      std::vector<cv::Mat> weights;
      std::vector<cv::Mat> biases;
+     std::mt19937 rng;
+     bool trace;
      bool validate(cv::Mat& data);
+     bool fits(const InferenceContext& context) const;
+     template <class T>
+     int predictInternal(const T* input, InferenceContext& context) const;
      void trainInternal(std::vector<cv::Mat>& data,
                         std::vector<cv::Mat>& desiredOutput,
                         std::vector<int>& indexes,
@@ -39,4 +81,19 @@ public:
                         );
 };
 
+//preallocated per thread storage for every layer activations used by NN::predict
+class InferenceContext {
+public:
+    InferenceContext(const NN& net);
+    const double* getScores() const;
+    int getScoresCount() const;
+    //the last layer results before applying sigmoid activation function
+    const double* getLogits() const;
+
+private:
+    friend class NN;
+    std::vector<std::vector<double>> activations;
+    std::vector<double> logits;
+};
+
 #endif // NN_H
@@ -0,0 +1,106 @@
+#include "online.h"
+#include <opencv2/core/core.hpp>
+using namespace cv;
+using namespace std;
+
+typedef vector<Mat> MAT_VEC;
+
+OnlineTrainer::OnlineTrainer(const NN& initial,
+                             int capacity,
+                             int batchSize,
+                             double learningRate,
+                             int publishInterval,
+                             unsigned seed) :
+    net(initial),
+    capacity(capacity),
+    batchSize(batchSize),
+    learningRate(learningRate),
+    publishInterval(max(1, publishInterval)),
+    seenCount(0),
+    updatesCount(0),
+    pushRng(seed),
+    trainRng(seed + 1),
+    stopped(false),
+    snapshot(make_shared<const NN>(initial)) {
+    assert(capacity >= batchSize);
+    assert(batchSize > 0);
+    inputs.reserve(capacity);
+    outputs.reserve(capacity);
+    trainer = thread(&OnlineTrainer::train, this);
+}
+
+OnlineTrainer::~OnlineTrainer() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopped = true;
+    }
+    readyCondition.notify_all();
+    trainer.join();
+}
+
+void OnlineTrainer::push(const Mat& input, const Mat& desiredOutput) {
+    Mat inputCopy = input.clone();
+    Mat outputCopy = desiredOutput.clone();
+    {
+        lock_guard<mutex> guard(lock);
+        if (inputs.size() < capacity) {
+            inputs.push_back(inputCopy);
+            outputs.push_back(outputCopy);
+        } else {
+            //keep every seen sample in the buffer with equal probability
+            uniform_int_distribution<long long> pickSlot(0, seenCount);
+            long long slot = pickSlot(pushRng);
+            if (slot < capacity) {
+                inputs[slot] = inputCopy;
+                outputs[slot] = outputCopy;
+            }
+        }
+        seenCount++;
+    }
+    readyCondition.notify_one();
+}
+
+shared_ptr<const NN> OnlineTrainer::getSnapshot() const {
+    return atomic_load(&snapshot);
+}
+
+long long OnlineTrainer::getSeenCount() {
+    lock_guard<mutex> guard(lock);
+    return seenCount;
+}
+
+long long OnlineTrainer::getUpdatesCount() {
+    lock_guard<mutex> guard(lock);
+    return updatesCount;
+}
+
+void OnlineTrainer::train() {
+    MAT_VEC batchInputs(batchSize);
+    MAT_VEC batchOutputs(batchSize);
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock);
+            readyCondition.wait(guard, [&]() { return stopped || inputs.size() >= batchSize; });
+            if (stopped) {
+                return;
+            }
+            //stored samples are never modified, replacing a slot only drops its reference, so
+            //the batch can be trained on after the lock is released
+            uniform_int_distribution<int> pickSample(0, inputs.size() - 1);
+            for (int i = 0; i < batchSize; ++i) {
+                int index = pickSample(trainRng);
+                batchInputs[i] = inputs[index];
+                batchOutputs[i] = outputs[index];
+            }
+        }
+        net.trainBatch(batchInputs, batchOutputs, learningRate);
+        long long updates;
+        {
+            lock_guard<mutex> guard(lock);
+            updates = ++updatesCount;
+        }
+        if (updates % publishInterval == 0) {
+            atomic_store(&snapshot, make_shared<const NN>(net));
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef ONLINE_H
+#define ONLINE_H
+#include "nn.h"
+#include <opencv2/core/core.hpp>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+//keeps training a private copy of the network on mini-batches drawn from a bounded replay buffer
+//filled by push, readers get the latest published copy of the network via getSnapshot
+class OnlineTrainer {
+public:
+    //capacity - replay buffer size, once it is full new samples replace random old ones with
+    //reservoir sampling probability, publishInterval - count of updates between snapshots
+    OnlineTrainer(const NN& initial,
+                  int capacity,
+                  int batchSize,
+                  double learningRate,
+                  int publishInterval,
+                  unsigned seed
+                  );
+    ~OnlineTrainer();
+    //safe to call from any thread, the sample is copied
+    void push(const cv::Mat& input, const cv::Mat& desiredOutput);
+    //snapshot is never changed after publishing, so it can be used without any locking
+    std::shared_ptr<const NN> getSnapshot() const;
+    long long getSeenCount();
+    long long getUpdatesCount();
+
+private:
+    NN net;
+    const int capacity;
+    const int batchSize;
+    const double learningRate;
+    const int publishInterval;
+    std::vector<cv::Mat> inputs;
+    std::vector<cv::Mat> outputs;
+    long long seenCount;
+    long long updatesCount;
+    std::mt19937 pushRng;
+    std::mt19937 trainRng;
+    bool stopped;
+    std::mutex lock;
+    std::condition_variable readyCondition;
+    std::shared_ptr<const NN> snapshot;
+    std::thread trainer;
+    void train();
+};
+
+#endif // ONLINE_H
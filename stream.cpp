@@ -0,0 +1,235 @@
+#include "stream.h"
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <iostream>
+using namespace cv;
+using namespace std;
+
+typedef vector<Mat> MAT_VEC;
+
+#define IMAGES_HEADER_SIZE 16
+#define LABELS_HEADER_SIZE 8
+
+MnistStream::MnistStream(const char* imagesFileName,
+                         const char* labelsFileName,
+                         int labelsCount,
+                         int chunkSize,
+                         int windowSize,
+                         int readAhead,
+                         int passes,
+                         unsigned seed) :
+    imagesFile(imagesFileName, ios::in|ios::binary),
+    labelsFile(labelsFileName, ios::in|ios::binary),
+    sampleSize(0),
+    samplesCount(0),
+    labelsCount(labelsCount),
+    chunkSize(chunkSize),
+    windowSize(windowSize),
+    passes(passes),
+    opened(false),
+    finished(false),
+    stopped(false),
+    current(0),
+    currentPosition(0),
+    windowCount(0),
+    rng(seed) {
+    assert(labelsCount > 0);
+    assert(chunkSize > 0);
+    assert(windowSize > 0);
+    assert(readAhead > 0);
+    opened = readHeaders();
+    if (!opened) {
+        finished = true;
+        return;
+    }
+    //one more chunk than read ahead is the one being consumed
+    chunks.resize(readAhead + 1);
+    for (int i = 0; i < chunks.size(); ++i) {
+        chunks[i].pixels.resize(chunkSize * sampleSize);
+        chunks[i].labels.resize(chunkSize);
+        chunks[i].count = 0;
+        freeChunks.push_back(&chunks[i]);
+    }
+    windowPixels.resize(windowSize * sampleSize);
+    windowLabels.resize(windowSize);
+    reader = thread(&MnistStream::read, this);
+}
+
+MnistStream::~MnistStream() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopped = true;
+    }
+    freeCondition.notify_all();
+    if (reader.joinable()) {
+        reader.join();
+    }
+}
+
+bool MnistStream::isOpen() {
+    return opened;
+}
+
+int MnistStream::getSampleSize() {
+    return sampleSize;
+}
+
+int MnistStream::getLabelsCount() {
+    return labelsCount;
+}
+
+long long MnistStream::getSamplesCount() {
+    return samplesCount;
+}
+
+bool MnistStream::readHeaders() {
+    if (!imagesFile.is_open() || !labelsFile.is_open()) {
+        cout << "Failed to open file";
+        return false;
+    }
+    int32_t header[4];
+    imagesFile.read((char*)header, IMAGES_HEADER_SIZE);
+    for (int i = 0; i < 4; ++i) {
+        header[i] = __builtin_bswap32(header[i]);
+    }
+    if (!imagesFile || header[0] != 2051 || header[1] <= 0 || header[2] <= 0 || header[3] <= 0) {
+        return false;
+    }
+    samplesCount = header[1];
+    sampleSize = header[2] * header[3];
+    labelsFile.read((char*)header, LABELS_HEADER_SIZE);
+    for (int i = 0; i < 2; ++i) {
+        header[i] = __builtin_bswap32(header[i]);
+    }
+    if (!labelsFile || header[0] != 2049 || header[1] != samplesCount) {
+        return false;
+    }
+    cout << "Streaming images: " << samplesCount << " Size: " << sampleSize << endl;
+    return true;
+}
+
+void MnistStream::read() {
+    for (int pass = 0; pass < passes; ++pass) {
+        imagesFile.clear();
+        labelsFile.clear();
+        imagesFile.seekg(IMAGES_HEADER_SIZE);
+        labelsFile.seekg(LABELS_HEADER_SIZE);
+        for (long long position = 0; position < samplesCount; position += chunkSize) {
+            Chunk* chunk;
+            {
+                unique_lock<mutex> guard(lock);
+                freeCondition.wait(guard, [&]() { return stopped || !freeChunks.empty(); });
+                if (stopped) {
+                    return;
+                }
+                chunk = freeChunks.back();
+                freeChunks.pop_back();
+            }
+            //read the whole chunk with a single call for each file
+            chunk->count = min<long long>(chunkSize, samplesCount - position);
+            imagesFile.read((char*)chunk->pixels.data(), chunk->count * sampleSize);
+            labelsFile.read((char*)chunk->labels.data(), chunk->count);
+            bool failed = !imagesFile || !labelsFile;
+            //labels are used as row indexes later, so never trust the file
+            for (int i = 0; i < chunk->count && !failed; ++i) {
+                failed = chunk->labels[i] >= labelsCount;
+            }
+            {
+                lock_guard<mutex> guard(lock);
+                if (failed) {
+                    freeChunks.push_back(chunk);
+                } else {
+                    readyChunks.push_back(chunk);
+                }
+            }
+            readyCondition.notify_one();
+            if (failed) {
+                cout << "Failed to read file";
+                pass = passes;
+                break;
+            }
+        }
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        finished = true;
+    }
+    readyCondition.notify_one();
+}
+
+bool MnistStream::nextIncoming(const uchar*& pixels, uchar& label) {
+    if (current && currentPosition == current->count) {
+        {
+            lock_guard<mutex> guard(lock);
+            freeChunks.push_back(current);
+        }
+        freeCondition.notify_one();
+        current = 0;
+    }
+    if (!current) {
+        unique_lock<mutex> guard(lock);
+        readyCondition.wait(guard, [&]() { return finished || !readyChunks.empty(); });
+        if (readyChunks.empty()) {
+            return false;
+        }
+        current = readyChunks.front();
+        readyChunks.pop_front();
+        currentPosition = 0;
+    }
+    pixels = current->pixels.data() + currentPosition * sampleSize;
+    label = current->labels[currentPosition];
+    currentPosition++;
+    return true;
+}
+
+int MnistStream::next(MAT_VEC& images, MAT_VEC& labels) {
+    if (images.size() != labels.size()) {
+        return 0;
+    }
+    for (int i = 0; i < images.size(); ++i) {
+        if (images[i].rows * images[i].cols != sampleSize ||
+                labels[i].rows * labels[i].cols != labelsCount) {
+            return 0;
+        }
+    }
+    int filled = 0;
+    while (filled < images.size()) {
+        const uchar* incomingPixels;
+        uchar incomingLabel;
+        bool incoming = nextIncoming(incomingPixels, incomingLabel);
+        if (incoming && windowCount < windowSize) {
+            //fill the window first
+            copy(incomingPixels, incomingPixels + sampleSize,
+                 windowPixels.begin() + windowCount * sampleSize);
+            windowLabels[windowCount] = incomingLabel;
+            windowCount++;
+            continue;
+        }
+        if (windowCount == 0) {
+            break;
+        }
+        //emit a random window sample and put the incoming one in its place, or shrink the window
+        //when the stream is over
+        uniform_int_distribution<int> pickSample(0, windowCount - 1);
+        int index = pickSample(rng);
+        const uchar* samplePixels = windowPixels.data() + index * sampleSize;
+        double* imagePoint = (double*) images[filled].data;
+        for (int i = 0; i < sampleSize; ++i) {
+            imagePoint[i] = samplePixels[i];
+        }
+        labels[filled] = Scalar(0);
+        labels[filled].at<double>(windowLabels[index], 0) = 1;
+        filled++;
+        uchar* slotPixels = windowPixels.data() + index * sampleSize;
+        if (incoming) {
+            copy(incomingPixels, incomingPixels + sampleSize, slotPixels);
+            windowLabels[index] = incomingLabel;
+        } else {
+            windowCount--;
+            const uchar* lastPixels = windowPixels.data() + windowCount * sampleSize;
+            copy(lastPixels, lastPixels + sampleSize, slotPixels);
+            windowLabels[index] = windowLabels[windowCount];
+        }
+    }
+    return filled;
+}
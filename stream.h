@@ -0,0 +1,76 @@
+#ifndef STREAM_H
+#define STREAM_H
+#include <opencv2/core/core.hpp>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+//reads MNIST IDX images and labels files in big sequential chunks on a background thread and
+//returns samples shuffled within a window of fixed size, so the memory used doesn't depend on
+//the dataset size
+class MnistStream {
+public:
+    //labelsCount - count of classes, a chunk with any bigger label is treated as read failure,
+    //chunkSize - samples per read, windowSize - samples kept for shuffling,
+    //readAhead - chunks read in advance, passes - times to read the whole dataset
+    MnistStream(const char* imagesFileName,
+                const char* labelsFileName,
+                int labelsCount,
+                int chunkSize,
+                int windowSize,
+                int readAhead,
+                int passes,
+                unsigned seed
+                );
+    ~MnistStream();
+    bool isOpen();
+    int getSampleSize();
+    int getLabelsCount();
+    long long getSamplesCount();
+    //fill preallocated images (sample size x 1, CV_64F) and labels (labels count x 1, CV_64F) with
+    //the next samples, returns count of filled ones which is less than requested only at the end,
+    //0 if the buffers have wrong sizes
+    int next(std::vector<cv::Mat>& images, std::vector<cv::Mat>& labels);
+
+private:
+    struct Chunk {
+        std::vector<uchar> pixels;
+        std::vector<uchar> labels;
+        int count;
+    };
+
+    std::ifstream imagesFile;
+    std::ifstream labelsFile;
+    int sampleSize;
+    long long samplesCount;
+    const int labelsCount;
+    const int chunkSize;
+    const int windowSize;
+    const int passes;
+    bool opened;
+    std::vector<Chunk> chunks;
+    std::vector<Chunk*> freeChunks;
+    std::deque<Chunk*> readyChunks;
+    bool finished;
+    bool stopped;
+    std::mutex lock;
+    std::condition_variable freeCondition;
+    std::condition_variable readyCondition;
+    std::thread reader;
+    //consumer side state, used only by next
+    Chunk* current;
+    int currentPosition;
+    std::vector<uchar> windowPixels;
+    std::vector<uchar> windowLabels;
+    int windowCount;
+    std::mt19937 rng;
+    bool readHeaders();
+    void read();
+    bool nextIncoming(const uchar*& pixels, uchar& label);
+};
+
+#endif // STREAM_H
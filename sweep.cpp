@@ -0,0 +1,103 @@
+#include "sweep.h"
+#include "nn.h"
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+using namespace cv;
+using namespace std;
+
+typedef vector<Mat> MAT_VEC;
+
+namespace sweep {
+    void traceConfig(ostream& output, const Config& config) {
+        output << "hidden=";
+        for (int i = 0; i < config.hidden.size(); ++i) {
+            output << (i == 0 ? "" : "x") << config.hidden[i];
+        }
+        output << " items=" << config.epochItemCount
+               << " epochs=" << config.epochCount
+               << " rate=" << config.learningRate;
+    }
+
+    static bool isBetter(const Result& left, const Result& right) {
+        //compare accuracies without division: left.correct / left.total > right.correct / right.total
+        long long leftScore = (long long) left.correct * right.total;
+        long long rightScore = (long long) right.correct * left.total;
+        if (leftScore != rightScore) {
+            return leftScore > rightScore;
+        }
+        return left.seconds < right.seconds;
+    }
+
+    vector<Result> run(MAT_VEC& trainingImages,
+                       MAT_VEC& trainingLabels,
+                       MAT_VEC& validateImages,
+                       MAT_VEC& validateLabels,
+                       const vector<Config>& configs,
+                       ostream& results,
+                       unsigned seed,
+                       NN::InferenceKernel kernel,
+                       int threadCount) {
+        vector<Result> ranked;
+        if (configs.empty() ||
+                trainingImages.empty() ||
+                trainingImages.size() != trainingLabels.size() ||
+                validateImages.size() != validateLabels.size()) {
+            return ranked;
+        }
+        if (threadCount <= 0) {
+            threadCount = max(1u, thread::hardware_concurrency());
+        }
+        threadCount = min<int>(threadCount, configs.size());
+        int inputSize = trainingImages[0].rows * trainingImages[0].cols;
+        int outputSize = trainingLabels[0].rows;
+        ranked.reserve(configs.size());
+        atomic<int> next(0);
+        mutex resultsLock;
+        //workers pull the next config as soon as they are done, so long runs don't hold up
+        //a statically assigned share of short ones
+        auto worker = [&]() {
+            for (int index = next++; index < configs.size(); index = next++) {
+                const Config& config = configs[index];
+                vector<int> layers;
+                layers.reserve(config.hidden.size() + 2);
+                layers.push_back(inputSize);
+                layers.insert(layers.end(), config.hidden.begin(), config.hidden.end());
+                layers.push_back(outputSize);
+
+                auto start = chrono::steady_clock::now();
+                NN net(layers, seed + index);
+                //concurrent per epoch trace from every worker is useless, the result is printed below
+                net.setTrace(false);
+                net.train(trainingImages, trainingLabels,
+                          config.epochItemCount, config.epochCount, config.learningRate);
+                Result result;
+                result.config = config;
+                result.correct = net.evaluate(validateImages, validateLabels, kernel);
+                result.total = validateImages.size();
+                result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                lock_guard<mutex> lock(resultsLock);
+                results << result.correct << "/" << result.total << " "
+                        << result.seconds << "s ";
+                traceConfig(results, config);
+                results << endl;
+                ranked.push_back(result);
+            }
+        };
+        vector<thread> workers;
+        workers.reserve(threadCount);
+        for (int i = 0; i < threadCount; ++i) {
+            workers.push_back(thread(worker));
+        }
+        for (int i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+        sort(ranked.begin(), ranked.end(), isBetter);
+        return ranked;
+    }
+}
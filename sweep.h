@@ -0,0 +1,41 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+#include "nn.h"
+#include <opencv2/core/core.hpp>
+#include <ostream>
+#include <vector>
+
+namespace sweep {
+    struct Config {
+        std::vector<int> hidden;
+        int epochItemCount;
+        int epochCount;
+        double learningRate;
+    };
+
+    struct Result {
+        Config config;
+        int correct;
+        int total;
+        double seconds;
+    };
+
+    void traceConfig(std::ostream& output, const Config& config);
+
+    //train every provided configuration on a shared read-only dataset using a pool of threadCount
+    //workers (0 - one worker per core), every finished run is written to results immediately,
+    //returned results are ranked by validation accuracy and then by wall time, a run for the config
+    //with index i is seeded with seed + i, so the results don't depend on threads scheduling
+    std::vector<Result> run(std::vector<cv::Mat>& trainingImages,
+                            std::vector<cv::Mat>& trainingLabels,
+                            std::vector<cv::Mat>& validateImages,
+                            std::vector<cv::Mat>& validateLabels,
+                            const std::vector<Config>& configs,
+                            std::ostream& results,
+                            unsigned seed,
+                            NN::InferenceKernel kernel,
+                            int threadCount = 0
+                            );
+}
+
+#endif // SWEEP_H
@@ -0,0 +1,190 @@
+#include "tuner.h"
+#include "nn.h"
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+using namespace cv;
+using namespace std;
+
+typedef vector<Mat> MAT_VEC;
+
+namespace tuner {
+    Profile defaultProfile() {
+        Profile profile;
+        profile.epochItemCount = 1000;
+        profile.inferenceKernel = NN::KERNEL_MATRIX;
+        profile.inferenceThreads = 0;
+        return profile;
+    }
+
+    bool loadProfile(const char* fileName, Profile& profile) {
+        ifstream file(fileName);
+        if (!file.is_open()) {
+            return false;
+        }
+        Profile loaded = defaultProfile();
+        string line;
+        while (getline(file, line)) {
+            size_t separator = line.find('=');
+            if (separator == string::npos) {
+                continue;
+            }
+            string key = line.substr(0, separator);
+            int value = atoi(line.c_str() + separator + 1);
+            if (key == "epochItemCount" && value > 0) {
+                loaded.epochItemCount = value;
+            } else if (key == "inferenceKernel" &&
+                       (value == NN::KERNEL_MATRIX || value == NN::KERNEL_LOOP)) {
+                loaded.inferenceKernel = NN::InferenceKernel(value);
+            } else if (key == "inferenceThreads" && value >= 0) {
+                loaded.inferenceThreads = value;
+            }
+        }
+        profile = loaded;
+        return true;
+    }
+
+    bool saveProfile(const char* fileName, const Profile& profile) {
+        ofstream file(fileName, ios::out|ios::trunc);
+        if (!file.is_open()) {
+            cout << "Failed to open file";
+            return false;
+        }
+        file << "epochItemCount=" << profile.epochItemCount << endl
+             << "inferenceKernel=" << profile.inferenceKernel << endl
+             << "inferenceThreads=" << profile.inferenceThreads << endl;
+        return bool(file);
+    }
+
+    const Profile& getActiveProfile() {
+        static const Profile profile = []() {
+            Profile loaded = defaultProfile();
+            loadProfile(PROFILE_FILE_NAME, loaded);
+            return loaded;
+        }();
+        return profile;
+    }
+
+    static double trainingTrial(const vector<int>& config,
+                                MAT_VEC& images,
+                                MAT_VEC& labels,
+                                int epochItemCount,
+                                double trialSeconds) {
+        vector<int> layers(config);
+        NN net(layers);
+        MAT_VEC batchImages(epochItemCount);
+        MAT_VEC batchLabels(epochItemCount);
+        long long processed = 0;
+        int offset = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < trialSeconds) {
+            for (int i = 0; i < epochItemCount; ++i) {
+                batchImages[i] = images[offset];
+                batchLabels[i] = labels[offset];
+                offset = (offset + 1) % images.size();
+            }
+            net.trainBatch(batchImages, batchLabels, 3);
+            processed += epochItemCount;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        return processed / elapsed;
+    }
+
+    static double inferenceTrial(const vector<int>& config,
+                                 MAT_VEC& images,
+                                 NN::InferenceKernel kernel,
+                                 int threadCount,
+                                 double trialSeconds) {
+        vector<int> layers(config);
+        const NN net(layers);
+        atomic<bool> stopped(false);
+        vector<long long> processed(threadCount, 0);
+        //every thread walks its own part of the dataset like a split batch inference does
+        auto worker = [&](int threadIndex) {
+            InferenceContext context(net);
+            int offset = threadIndex * images.size() / threadCount;
+            long long count = 0;
+            while (!stopped) {
+                //check time once per a small group of samples, single inference is too short
+                for (int i = 0; i < 100; ++i) {
+                    if (kernel == NN::KERNEL_MATRIX) {
+                        net.feedfoward(images[offset]);
+                    } else {
+                        net.predict((const double*) images[offset].data, context);
+                    }
+                    offset = (offset + 1) % images.size();
+                }
+                count += 100;
+            }
+            processed[threadIndex] = count;
+        };
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (int i = 0; i < threadCount; ++i) {
+            workers.push_back(thread(worker, i));
+        }
+        this_thread::sleep_for(chrono::duration<double>(trialSeconds));
+        stopped = true;
+        for (int i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        long long total = 0;
+        for (int i = 0; i < processed.size(); ++i) {
+            total += processed[i];
+        }
+        return total / elapsed;
+    }
+
+    Profile tune(MAT_VEC& images, MAT_VEC& labels, double trialSeconds) {
+        Profile best = defaultProfile();
+        if (images.empty() || images.size() != labels.size()) {
+            return best;
+        }
+        vector<int> config = { images[0].rows * images[0].cols, 30, labels[0].rows };
+        vector<int> epochItemCounts = { 10, 30, 100, 300, 1000 };
+
+        double bestTraining = 0;
+        for (int epochItemCount : epochItemCounts) {
+            double rate = trainingTrial(config, images, labels, epochItemCount, trialSeconds);
+            cout << "train items=" << epochItemCount << ": " << rate << " samples/s" << endl;
+            if (rate > bestTraining) {
+                bestTraining = rate;
+                best.epochItemCount = epochItemCount;
+            }
+        }
+
+        double bestInference = 0;
+        NN::InferenceKernel kernels[] = { NN::KERNEL_MATRIX, NN::KERNEL_LOOP };
+        for (NN::InferenceKernel kernel : kernels) {
+            double rate = inferenceTrial(config, images, kernel, 1, trialSeconds);
+            cout << "inference kernel=" << kernel << ": " << rate << " samples/s" << endl;
+            if (rate > bestInference) {
+                bestInference = rate;
+                best.inferenceKernel = kernel;
+            }
+        }
+
+        vector<int> threadCounts;
+        int cpus = max(1u, thread::hardware_concurrency());
+        for (int threads = 1; threads < cpus; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(cpus);
+        bestInference = 0;
+        for (int threads : threadCounts) {
+            double rate = inferenceTrial(config, images, best.inferenceKernel, threads, trialSeconds);
+            cout << "inference threads=" << threads << ": " << rate << " samples/s" << endl;
+            if (rate > bestInference) {
+                bestInference = rate;
+                best.inferenceThreads = threads;
+            }
+        }
+        return best;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef TUNER_H
+#define TUNER_H
+#include "nn.h"
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+#define PROFILE_FILE_NAME "digits.profile"
+
+namespace tuner {
+    struct Profile {
+        //mini-batch size with the best training throughput, it also changes learning dynamics,
+        //so the total samples count should be kept when it is used
+        int epochItemCount;
+        //kernel to pass to NN::evaluate and the other validation paths
+        NN::InferenceKernel inferenceKernel;
+        //threads count for batch inference over a whole dataset with NN::predict, each thread
+        //with its own context (0 - one per core)
+        int inferenceThreads;
+    };
+
+    Profile defaultProfile();
+
+    bool loadProfile(const char* fileName, Profile& profile);
+
+    bool saveProfile(const char* fileName, const Profile& profile);
+
+    //profile loaded from PROFILE_FILE_NAME in the working directory on the first call, defaults if
+    //there is no such file
+    const Profile& getActiveProfile();
+
+    //run timed trials of training and inference for every knob value, each lasting about
+    //trialSeconds, and return the fastest combination in samples per second
+    Profile tune(std::vector<cv::Mat>& images,
+                 std::vector<cv::Mat>& labels,
+                 double trialSeconds
+                 );
+}
+
+#endif // TUNER_H
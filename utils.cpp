@@ -1,10 +1,6 @@
 #include "utils.h"
 
 namespace utils {
-    static inline double sigmoid(double input) {
-        return 1.0 / (1.0 + exp((-1) * input));
-    }
-
     cv::Mat sigmoid(const cv::Mat& input) {
         cv::Mat simoided = input.clone();
         for(int row = 0; row < simoided.rows; ++row) {
@@ -4,8 +4,13 @@
 #include <vector>
 #include <stack>
 #include <iostream>
+#include <random>
 #include <opencv2/core/core.hpp>
 namespace utils {
+    inline double sigmoid(const double input) {
+        return 1.0 / (1.0 + exp((-1) * input));
+    }
+
     cv::Mat sigmoid(const cv::Mat& input);
 
     double sigmoidDerivative(const double input);
@@ -62,5 +67,32 @@ namespace utils {
         }
     }
 
+    //the same as above but takes random numbers from the provided generator instead of rand()
+    template <class T, class RNG>
+    void shuffleOptimal(std::vector<T>& data, std::vector<T>& output, RNG& rng) {
+        assert(data.size() >= output.capacity());
+        assert(data.size() != 0);
+        int maxDataIndex = data.size() - 1;
+        std::stack<int> indexes;
+        for (int i = 0; i < output.capacity(); ++i) {
+            std::uniform_int_distribution<int> pickIndex(0, maxDataIndex - i - 1);
+            int index = pickIndex(rng);
+            indexes.push(index);
+            T tmp = data[index];
+            data[index] = data[maxDataIndex - i];
+            data[maxDataIndex - i] = tmp;
+            output.push_back(tmp);
+        }
+        //restore back original order
+        while(!indexes.empty()) {
+            int position = indexes.size() - 1;
+            int index = indexes.top();
+            indexes.pop();
+            T tmp = data[maxDataIndex - position];
+            data[maxDataIndex - position] = data[index];
+            data[index] = tmp;
+        }
+    }
+
 }
 #endif // UTILS_H